@@ -0,0 +1,102 @@
+#ifndef POCKETWATCH_HOST_ADAFRUIT_NEOPIXEL_H
+#define POCKETWATCH_HOST_ADAFRUIT_NEOPIXEL_H
+
+#include <vector>
+
+#include "Arduino.h"
+
+#define NEO_RGB 0x06
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+// Each pixel takes 30 usec on the wire at 800 kHz, with interrupts off
+#define POCKETWATCH__HOST__NEOPIXELMICROS 30
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Keeps what's been set and what was last latched by show() separately, so the
+// simulator sees exactly what the LEDs would be showing.
+class Adafruit_NeoPixel
+{
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t, uint16_t = NEO_GRB + NEO_KHZ800) : pixels(n, 0),
+                                                                            shown(n, 0),
+                                                                            brightness(0),
+                                                                            numShows(0),
+                                                                            numChangedShows(0),
+                                                                            showMicros(0)
+  {
+  }
+
+  void begin() {}
+
+  void show()
+  {
+    ++numShows;
+    showMicros += pixels.size() * POCKETWATCH__HOST__NEOPIXELMICROS;
+    if (pixels != shown)
+    {
+      ++numChangedShows;
+      shown = pixels;
+    }
+  }
+
+  void setPixelColor(uint16_t n, uint32_t c)
+  {
+    if (n < pixels.size())
+    {
+      pixels[n] = scale(c);
+    }
+  }
+
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+  {
+    setPixelColor(n, Color(r, g, b));
+  }
+
+  uint32_t getPixelColor(uint16_t n) const { return (n < pixels.size()) ? pixels[n] : 0; }
+
+  void setBrightness(uint8_t b) { brightness = b + 1; }
+  uint8_t getBrightness() const { return brightness - 1; }
+
+  void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+  uint16_t numPixels() const { return pixels.size(); }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+
+  // What the LEDs are showing
+  const std::vector<uint32_t>& getShown() const { return shown; }
+
+  unsigned long getNumShows() const { return numShows; }
+  unsigned long getNumChangedShows() const { return numChangedShows; }
+  unsigned long getShowMicros() const { return showMicros; }
+
+private:
+
+  // Brightness is applied as pixels are set, as in the real library
+  uint32_t scale(uint32_t c) const
+  {
+    if (brightness == 0)
+    {
+      return c;
+    }
+    uint8_t r = (((c >> 16) & 0xFF) * brightness) >> 8;
+    uint8_t g = (((c >> 8) & 0xFF) * brightness) >> 8;
+    uint8_t b = ((c & 0xFF) * brightness) >> 8;
+    return Color(r, g, b);
+  }
+
+  std::vector<uint32_t> pixels;
+  std::vector<uint32_t> shown;
+  uint16_t brightness;
+
+  unsigned long numShows;
+  unsigned long numChangedShows;
+  unsigned long showMicros;
+};
+
+#endif
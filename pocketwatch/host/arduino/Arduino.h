@@ -0,0 +1,358 @@
+#ifndef POCKETWATCH_HOST_ARDUINO_H
+#define POCKETWATCH_HOST_ARDUINO_H
+
+// Just enough of the Arduino core for the sketch to build and run on Linux.
+// Time is a virtual clock that only moves when the simulator (or delay())
+// moves it, so a run is the same every time no matter how fast the host is.
+//
+// Note that int is 32 bits here and 16 bits on the AVR, and double is 64 bits
+// instead of 32: overflow in 16-bit int arithmetic won't show up on the host.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define PI 3.1415926535897932384626433832795
+
+// Arduino Uno pin numbers
+#define NUM_DIGITAL_PINS 20
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define SDA A4
+#define SCL A5
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+// Program memory is just memory
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+
+using std::max;
+using std::min;
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+struct Clock
+{
+  Clock() : now(0) {}
+
+  // Only ever moves forward
+  void advanceTo(unsigned long micros)
+  {
+    if ((long)(micros - now) > 0)
+    {
+      now = micros;
+    }
+  }
+
+  unsigned long now; // Microseconds
+};
+
+static Clock clock;
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// A stepper driver on four pins, decoded back into a position by watching the
+// half-step sequence Motor drives them through.
+struct Stepper
+{
+  Stepper() : numPins(0),
+              state(-1),
+              position(0),
+              numSteps(0),
+              numBadSteps(0),
+              minStepMicros(0),
+              lastStepMicros(0),
+              numFastSteps(0)
+  {
+  }
+
+  void attach(uint8_t a1, uint8_t a2, uint8_t b1, uint8_t b2, unsigned long minStep)
+  {
+    pins[0] = a1;
+    pins[1] = a2;
+    pins[2] = b1;
+    pins[3] = b2;
+    numPins = 4;
+    minStepMicros = minStep;
+  }
+
+  bool uses(uint8_t pin) const
+  {
+    for (uint8_t i = 0; i < numPins; ++i)
+    {
+      if (pins[i] == pin)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Which of Motor's eight states the pins are in, or -1 if the coils are off
+  // (or in the middle of changing)
+  static int coil(uint8_t level1, uint8_t level2)
+  {
+    // 1 for up, -1 for down, 0 for off
+    if (level1 && ! level2)
+    {
+      return 1;
+    }
+    if ( ! level1 && level2)
+    {
+      return -1;
+    }
+    if (level1 && level2)
+    {
+      return 0;
+    }
+    return 2;
+  }
+
+  void update(const uint8_t* levels)
+  {
+    static const int states[3][3] =
+    {
+      // B down, B off, B up
+      {  5,  6,  7 }, // A down
+      {  4, -1,  0 }, // A off
+      {  3,  2,  1 }  // A up
+    };
+
+    int a = coil(levels[pins[0]], levels[pins[1]]);
+    int b = coil(levels[pins[2]], levels[pins[3]]);
+    if ((a == 2) || (b == 2))
+    {
+      return;
+    }
+    int s = states[a + 1][b + 1];
+    if (s < 0)
+    {
+      return;
+    }
+
+    if (state >= 0)
+    {
+      int delta = (s - state) & 0x7;
+      if ((delta == 1) || (delta == 7))
+      {
+        position += (delta == 1) ? 1 : -1;
+        // A real motor can't keep up with steps closer together than this
+        if ((numSteps > 0) && (clock.now - lastStepMicros < minStepMicros))
+        {
+          ++numFastSteps;
+        }
+        ++numSteps;
+        lastStepMicros = clock.now;
+      }
+      else if (delta != 0)
+      {
+        ++numBadSteps;
+      }
+    }
+    state = s;
+  }
+
+  uint8_t pins[4];
+  uint8_t numPins;
+  int state;
+  long position; // Half steps clockwise from where it started
+  unsigned long numSteps;
+  unsigned long numBadSteps;
+
+  unsigned long minStepMicros;
+  unsigned long lastStepMicros;
+  unsigned long numFastSteps; // Closer to the previous step than minStepMicros
+};
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+struct Pins
+{
+  Pins() : numSteppers(0), numWrites(0)
+  {
+    for (uint8_t i = 0; i < NUM_DIGITAL_PINS; ++i)
+    {
+      levels[i] = LOW;
+      inputs[i] = LOW;
+      analog[i] = 0;
+    }
+  }
+
+  Stepper& addStepper(uint8_t a1, uint8_t a2, uint8_t b1, uint8_t b2, unsigned long minStepMicros)
+  {
+    steppers[numSteppers].attach(a1, a2, b1, b2, minStepMicros);
+    return steppers[numSteppers++];
+  }
+
+  void write(uint8_t pin, uint8_t level)
+  {
+    if (pin >= NUM_DIGITAL_PINS)
+    {
+      return;
+    }
+    ++numWrites;
+    levels[pin] = level ? HIGH : LOW;
+    for (uint8_t i = 0; i < numSteppers; ++i)
+    {
+      if (steppers[i].uses(pin))
+      {
+        steppers[i].update(levels);
+      }
+    }
+  }
+
+  uint8_t levels[NUM_DIGITAL_PINS]; // What the sketch wrote
+  uint8_t inputs[NUM_DIGITAL_PINS]; // What the sketch reads
+  int analog[NUM_DIGITAL_PINS];
+
+  Stepper steppers[4];
+  uint8_t numSteppers;
+
+  unsigned long numWrites;
+};
+
+static Pins pins;
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Collects everything printed, since the sketch's debug output is part of what
+// it costs to run
+struct HardwareSerial
+{
+  HardwareSerial() : echo(false), numBytes(0) {}
+
+  void begin(unsigned long) {}
+
+  size_t write(uint8_t c)
+  {
+    ++numBytes;
+    if (echo)
+    {
+      fputc(c, stderr);
+    }
+    return 1;
+  }
+  size_t print(const char* s)
+  {
+    size_t n = 0;
+    for (; s[n] != '\0'; ++n)
+    {
+      write(s[n]);
+    }
+    return n;
+  }
+  size_t print(char c) { return write(c); }
+  size_t print(long value) { return print(std::to_string(value).c_str()); }
+  size_t print(unsigned long value) { return print(std::to_string(value).c_str()); }
+  size_t print(int value) { return print((long)value); }
+  size_t print(unsigned int value) { return print((unsigned long)value); }
+  size_t print(unsigned char value) { return print((unsigned long)value); }
+  size_t print(double value) { return print(std::to_string(value).c_str()); }
+  template <typename T> size_t println(T value) { return print(value) + println(); }
+  size_t println() { return print("\r\n"); }
+
+  bool echo;
+  unsigned long numBytes;
+};
+
+} // end namespace host
+} // end namespace pocketwatch
+
+static pocketwatch::host::HardwareSerial Serial;
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline unsigned long micros()
+{
+  return pocketwatch::host::clock.now;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline unsigned long millis()
+{
+  return pocketwatch::host::clock.now / 1000UL;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline void delayMicroseconds(unsigned int duration)
+{
+  pocketwatch::host::clock.advanceTo(pocketwatch::host::clock.now + duration);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline void delay(unsigned long duration)
+{
+  pocketwatch::host::clock.advanceTo(pocketwatch::host::clock.now + duration * 1000UL);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline void pinMode(uint8_t, uint8_t)
+{
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+  pocketwatch::host::pins.write(pin, level);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline int digitalRead(uint8_t pin)
+{
+  return (pin < NUM_DIGITAL_PINS) ? pocketwatch::host::pins.inputs[pin] : LOW;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline int analogRead(uint8_t pin)
+{
+  return (pin < NUM_DIGITAL_PINS) ? pocketwatch::host::pins.analog[pin] : 0;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+inline void attachInterrupt(uint8_t, void (*)(), int)
+{
+  // Nothing on the host raises interrupts
+}
+
+#endif
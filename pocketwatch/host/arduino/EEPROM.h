@@ -0,0 +1,98 @@
+#ifndef POCKETWATCH_HOST_EEPROM_H
+#define POCKETWATCH_HOST_EEPROM_H
+
+#include "Arduino.h"
+
+// ATmega328P
+#define POCKETWATCH__HOST__EEPROMSIZE 1024
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Starts out erased, and counts how often each cell is actually programmed so
+// wear shows up in the results.
+struct EEPROMClass
+{
+  EEPROMClass() : numReads(0), numWrites(0)
+  {
+    erase();
+  }
+
+  void erase()
+  {
+    memset(cells, 0xFF, sizeof(cells));
+    memset(wear, 0, sizeof(wear));
+  }
+
+  uint8_t read(int address)
+  {
+    ++numReads;
+    return cells[address % POCKETWATCH__HOST__EEPROMSIZE];
+  }
+
+  void write(int address, uint8_t value)
+  {
+    address %= POCKETWATCH__HOST__EEPROMSIZE;
+    ++numWrites;
+    ++wear[address];
+    cells[address] = value;
+  }
+
+  void update(int address, uint8_t value)
+  {
+    if (cells[address % POCKETWATCH__HOST__EEPROMSIZE] != value)
+    {
+      write(address, value);
+    }
+  }
+
+  template <typename T> T& get(int address, T& t)
+  {
+    uint8_t* bytes = (uint8_t*)(&t);
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+      bytes[i] = read(address + i);
+    }
+    return t;
+  }
+
+  template <typename T> const T& put(int address, const T& t)
+  {
+    const uint8_t* bytes = (const uint8_t*)(&t);
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+      update(address + i, bytes[i]);
+    }
+    return t;
+  }
+
+  uint16_t length() { return POCKETWATCH__HOST__EEPROMSIZE; }
+
+  unsigned long maxWear() const
+  {
+    unsigned long most = 0;
+    for (uint16_t i = 0; i < POCKETWATCH__HOST__EEPROMSIZE; ++i)
+    {
+      most = max(most, wear[i]);
+    }
+    return most;
+  }
+
+  uint8_t cells[POCKETWATCH__HOST__EEPROMSIZE];
+  unsigned long wear[POCKETWATCH__HOST__EEPROMSIZE];
+
+  unsigned long numReads;
+  unsigned long numWrites;
+};
+
+} // end namespace host
+} // end namespace pocketwatch
+
+static pocketwatch::host::EEPROMClass EEPROM;
+
+#endif
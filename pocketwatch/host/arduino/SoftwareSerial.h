@@ -0,0 +1,151 @@
+#ifndef POCKETWATCH_HOST_SOFTWARESERIAL_H
+#define POCKETWATCH_HOST_SOFTWARESERIAL_H
+
+#include <deque>
+
+#include "Arduino.h"
+
+// Same as the real library's receive buffer
+#define _SS_MAX_RX_BUFF 64
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// The serial line from the GPS. Characters are queued with the time their stop
+// bit arrives, and only land in the receive buffer once the clock gets there;
+// anything arriving while the buffer is full is lost, just like on the board.
+struct SerialLine
+{
+  SerialLine() : baud(9600),
+                 lineFreeTime(0),
+                 head(0),
+                 tail(0),
+                 overflowed(false),
+                 numReceived(0),
+                 numDropped(0)
+  {
+  }
+
+  // Queue a string to start arriving at startMicros (or as soon as the line is
+  // free), one character every 10 bit times
+  void send(unsigned long startMicros, const std::string& s)
+  {
+    unsigned long characterTime = 10000000UL / baud;
+    unsigned long t = ((long)(startMicros - lineFreeTime) > 0) ? startMicros : lineFreeTime;
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+      t += characterTime;
+      pending.push_back(std::make_pair(t, (uint8_t)s[i]));
+    }
+    lineFreeTime = t;
+  }
+
+  void deliver()
+  {
+    while ( ! pending.empty() && ((long)(clock.now - pending.front().first) >= 0))
+    {
+      uint8_t next = (tail + 1) % _SS_MAX_RX_BUFF;
+      if (next == head)
+      {
+        overflowed = true;
+        ++numDropped;
+      }
+      else
+      {
+        buffer[tail] = pending.front().second;
+        tail = next;
+        ++numReceived;
+      }
+      pending.pop_front();
+    }
+  }
+
+  int available()
+  {
+    deliver();
+    return (tail + _SS_MAX_RX_BUFF - head) % _SS_MAX_RX_BUFF;
+  }
+
+  int read()
+  {
+    deliver();
+    if (head == tail)
+    {
+      return -1;
+    }
+    uint8_t c = buffer[head];
+    head = (head + 1) % _SS_MAX_RX_BUFF;
+    return c;
+  }
+
+  unsigned long baud;
+  unsigned long lineFreeTime;
+  std::deque<std::pair<unsigned long, uint8_t> > pending;
+
+  uint8_t buffer[_SS_MAX_RX_BUFF];
+  uint8_t head;
+  uint8_t tail;
+  bool overflowed;
+
+  unsigned long numReceived;
+  unsigned long numDropped;
+
+  std::string transmitted; // Whatever the sketch sent to the GPS
+};
+
+static SerialLine gpsLine;
+
+} // end namespace host
+} // end namespace pocketwatch
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+class SoftwareSerial
+{
+public:
+  SoftwareSerial(uint8_t, uint8_t) {}
+
+  void begin(long baud) { pocketwatch::host::gpsLine.baud = baud; }
+  void end() {}
+  bool listen() { return false; }
+  bool isListening() { return true; }
+
+  int available() { return pocketwatch::host::gpsLine.available(); }
+  int read() { return pocketwatch::host::gpsLine.read(); }
+  int peek()
+  {
+    pocketwatch::host::SerialLine& line = pocketwatch::host::gpsLine;
+    line.deliver();
+    return (line.head == line.tail) ? -1 : line.buffer[line.head];
+  }
+
+  bool overflow()
+  {
+    bool result = pocketwatch::host::gpsLine.overflowed;
+    pocketwatch::host::gpsLine.overflowed = false;
+    return result;
+  }
+
+  size_t write(uint8_t c)
+  {
+    pocketwatch::host::gpsLine.transmitted += (char)c;
+    return 1;
+  }
+  size_t print(const char* s)
+  {
+    size_t n = 0;
+    for (; s[n] != '\0'; ++n)
+    {
+      write(s[n]);
+    }
+    return n;
+  }
+  size_t println(const char* s) { return print(s) + print("\r\n"); }
+};
+
+#endif
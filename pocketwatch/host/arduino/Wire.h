@@ -0,0 +1,154 @@
+#ifndef POCKETWATCH_HOST_WIRE_H
+#define POCKETWATCH_HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define WIRE_HAS_TIMEOUT 1
+
+#define POCKETWATCH__HOST__MAGNETOMETERADDRESS 0x1E
+#define POCKETWATCH__HOST__WIREBUFFER 32
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// An HMC5883L: a register pointer, a handful of registers, and a field that the
+// simulator sets from the trace.
+struct Magnetometer
+{
+  Magnetometer() : pointer(0), x(0), y(0), z(0), nack(false)
+  {
+    memset(registers, 0, sizeof(registers));
+  }
+
+  uint8_t read()
+  {
+    uint8_t value;
+    // Data output registers are X, Z, Y, most significant byte first
+    switch (pointer)
+    {
+      case 3: value = (uint8_t)(x >> 8); break;
+      case 4: value = (uint8_t)(x & 0xFF); break;
+      case 5: value = (uint8_t)(z >> 8); break;
+      case 6: value = (uint8_t)(z & 0xFF); break;
+      case 7: value = (uint8_t)(y >> 8); break;
+      case 8: value = (uint8_t)(y & 0xFF); break;
+      default: value = (pointer < sizeof(registers)) ? registers[pointer] : 0; break;
+    }
+    pointer = (pointer + 1) % 13;
+    return value;
+  }
+
+  void write(uint8_t value)
+  {
+    if (pointer < 3)
+    {
+      registers[pointer] = value;
+    }
+    pointer = (pointer + 1) % 13;
+  }
+
+  uint8_t registers[13];
+  uint8_t pointer;
+
+  int16_t x;
+  int16_t y;
+  int16_t z;
+
+  bool nack; // Pretend the sensor has dropped off the bus
+};
+
+static Magnetometer magnetometer;
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+struct TwoWire
+{
+  TwoWire() : address(0),
+              firstByte(false),
+              rxLength(0),
+              rxIndex(0),
+              numTransmissions(0),
+              numRequests(0),
+              numResets(0)
+  {
+  }
+
+  void begin() { ++numResets; }
+  void end() {}
+  void setClock(unsigned long) {}
+  void setWireTimeout(unsigned long = 25000, bool = false) {}
+
+  void beginTransmission(uint8_t a)
+  {
+    address = a;
+    firstByte = true;
+  }
+
+  size_t write(uint8_t value)
+  {
+    if (address != POCKETWATCH__HOST__MAGNETOMETERADDRESS)
+    {
+      return 1;
+    }
+    // The first byte of a write sets the register pointer
+    if (firstByte)
+    {
+      magnetometer.pointer = value;
+      firstByte = false;
+    }
+    else
+    {
+      magnetometer.write(value);
+    }
+    return 1;
+  }
+
+  uint8_t endTransmission(bool = true)
+  {
+    ++numTransmissions;
+    // 2 is a NACK on the address
+    return ((address == POCKETWATCH__HOST__MAGNETOMETERADDRESS) && ! magnetometer.nack) ? 0 : 2;
+  }
+
+  uint8_t requestFrom(int a, int quantity)
+  {
+    ++numRequests;
+    rxLength = 0;
+    rxIndex = 0;
+    if ((a != POCKETWATCH__HOST__MAGNETOMETERADDRESS) || magnetometer.nack)
+    {
+      return 0;
+    }
+    for (; (rxLength < quantity) && (rxLength < POCKETWATCH__HOST__WIREBUFFER); ++rxLength)
+    {
+      rxBuffer[rxLength] = magnetometer.read();
+    }
+    return rxLength;
+  }
+
+  int available() { return rxLength - rxIndex; }
+  int read() { return (rxIndex < rxLength) ? rxBuffer[rxIndex++] : -1; }
+
+  uint8_t address;
+  bool firstByte;
+
+  uint8_t rxBuffer[POCKETWATCH__HOST__WIREBUFFER];
+  uint8_t rxLength;
+  uint8_t rxIndex;
+
+  unsigned long numTransmissions;
+  unsigned long numRequests;
+  unsigned long numResets;
+};
+
+} // end namespace host
+} // end namespace pocketwatch
+
+static pocketwatch::host::TwoWire Wire;
+
+#endif
@@ -0,0 +1,352 @@
+// Checks every hand Display works out in fixed point against the float and
+// double code it replaced, which each must stay within one position of.
+// --bench instead times the waypoint hands both ways on the host.
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../main/pocketwatch.Display.H"
+
+#define POCKETWATCH__DISPLAYTEST__SAMPLES 200000
+#define POCKETWATCH__DISPLAYTEST__BENCHSAMPLES 20000
+#define POCKETWATCH__DISPLAYTEST__BENCHROUNDS 10
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// The hand positions the old floating point code would have given
+uint8_t floatNormalize(double value, double range)
+{
+  value = fmod(value, range);
+  if (value < 0.0)
+  {
+    value += range;
+  }
+  return (uint8_t)(value * POCKETWATCH__DISPLAY__NUMPOSITIONS / range);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+uint8_t floatSpeed(uint16_t groundSpeedCentiKnots)
+{
+  float groundSpeed = groundSpeedCentiKnots / 100.0f * 1.8519984f;
+  if (groundSpeed > 1000.0f)
+  {
+    groundSpeed = (groundSpeed / 14400.0f + (25.0f / 72.0f));
+  }
+  else
+  {
+    float t = (float)((-5.0 + sqrt(25.0f + 2.0f * groundSpeed)) / 40.0);
+    groundSpeed = (17.0f * t - 7.0f * t * t) / 24.0f;
+  }
+  return floatNormalize(groundSpeed - 0.25f, 1.0);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+uint8_t floatAltitude(int32_t altitudeDecimeters)
+{
+  float altPercent = altitudeDecimeters / 10.0f / 15000.0f;
+  if (altPercent < 0.0f)
+  {
+    altPercent /= 4.0f;
+  }
+  return floatNormalize(1.0f / 3.0f - altPercent, 1.0);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+void floatDistanceAndDirection(uint8_t& dist,
+                               uint8_t& dir,
+                               int32_t fromLatE7,
+                               int32_t fromLonE7,
+                               int32_t toLatE7,
+                               int32_t toLonE7,
+                               uint16_t forward)
+{
+  double fromLat = fromLatE7 * M_PI / 1.8e9;
+  double fromLong = fromLonE7 * M_PI / 1.8e9;
+  double toLat = toLatE7 * M_PI / 1.8e9;
+  double toLong = toLonE7 * M_PI / 1.8e9;
+
+  double a = sin((toLat - fromLat) / 2.0) * sin((toLat - fromLat) / 2.0) +
+             cos(toLat) * cos(fromLat) * sin((toLong - fromLong) / 2.0) * sin((toLong - fromLong) / 2.0);
+  double meters = EARTH__RADIUS * 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
+  double distFraction = min(log10(max(meters, 3.17)) * 0.1 - 0.05, 0.7);
+  dist = floatNormalize(-distFraction, 1.0);
+
+  double b = atan2(sin(toLong - fromLong) * cos(toLat),
+                   cos(fromLat) * sin(toLat) - sin(fromLat) * cos(toLat) * cos(toLong - fromLong));
+  dir = floatNormalize(b - forward * 2.0 * M_PI / 65536.0, 2.0 * M_PI);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Real time on the host: the cycle counter where there is one, otherwise
+// nanoseconds
+inline unsigned long cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return (unsigned long)__rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long)now.tv_sec * 1000000000UL + now.tv_nsec;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// How many positions apart two hands are, the short way round
+uint8_t handError(uint8_t a, uint8_t b)
+{
+  uint8_t difference = (a > b) ? (a - b) : (b - a);
+  return min(difference, (uint8_t)(POCKETWATCH__DISPLAY__NUMPOSITIONS - difference));
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+bool check(const char* what, uint8_t error)
+{
+  bool ok = (error <= 1);
+  printf("%-18s %10u (limit 1)%s\n", what, error, ok ? "" : "  FAILED");
+  return ok;
+}
+
+Display display;
+types::SensorData data = types::SensorData();
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Has the display work the hands out again from everything in data
+const types::Hands& recalculate()
+{
+  ++data.gpsGeneration;
+  ++data.directionGeneration;
+  ++data.positionGeneration;
+  ++data.waypointGeneration;
+  display.process(data);
+  return display.getHands();
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int displayTest()
+{
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  types::MotorConfig noMotor;
+  noMotor.pinA1 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinA2 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinB1 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinB2 = POCKETWATCH__MOTOR__NOPIN;
+  display.start(1500,
+                6000,
+                POCKETWATCH__DISPLAY__NUMPOSITIONS,
+                960,
+                noMotor,
+                noMotor,
+                noMotor,
+                false);
+
+  // Every second of the day
+  uint8_t timeError = 0;
+  data.selection = 0;
+  for (long s = 0; s < 86400L; ++s)
+  {
+    data.hour = s / 3600;
+    data.minute = (s / 60) % 60;
+    data.second = s % 60;
+    const types::Hands& hands = recalculate();
+
+    double second = data.second;
+    double minute = data.minute * 60.0 + second;
+    double hour = (data.hour - 7) * 3600.0 + minute;
+    timeError = max(timeError, handError(hands.bigHand, floatNormalize(hour, 43200.0)));
+    timeError = max(timeError, handError(hands.mediumHand, floatNormalize(minute, 3600.0)));
+    timeError = max(timeError, handError(hands.smallHand, floatNormalize(second, 60.0)));
+  }
+
+  // Every speed, every heading, and altitudes from the Dead Sea to well above
+  // anything the watch is likely to go
+  uint8_t northError = 0;
+  uint8_t speedError = 0;
+  uint8_t altitudeError = 0;
+  data.selection = 1;
+  for (long i = 0; i < 65536L; ++i)
+  {
+    data.forwardDirection = i;
+    data.groundSpeedCentiKnots = i;
+    data.altitudeDecimeters = (int32_t)(uniform(random) * 1200000.0) - 400000;
+    const types::Hands& hands = recalculate();
+
+    northError = max(northError, handError(hands.bigHand, floatNormalize(-i * 2.0 * M_PI / 65536.0, 2.0 * M_PI)));
+    speedError = max(speedError, handError(hands.mediumHand, floatSpeed(data.groundSpeedCentiKnots)));
+    altitudeError = max(altitudeError, handError(hands.smallHand, floatAltitude(data.altitudeDecimeters)));
+  }
+
+  // Waypoints from a few meters to the far side of the world
+  uint8_t distanceError = 0;
+  uint8_t directionError = 0;
+  data.selection = 2;
+  for (long i = 0; i < POCKETWATCH__DISPLAYTEST__SAMPLES; ++i)
+  {
+    double fromLat = uniform(random) * 170.0 - 85.0;
+    double fromLon = uniform(random) * 360.0 - 180.0;
+    double toLat;
+    double toLon;
+    if (i % 2)
+    {
+      double scale = pow(10.0, -4.0 + uniform(random) * 3.6);
+      toLat = max(-89.0, min(89.0, fromLat + (uniform(random) * 2.0 - 1.0) * scale));
+      toLon = remainder(fromLon + (uniform(random) * 2.0 - 1.0) * scale, 360.0);
+    }
+    else
+    {
+      toLat = uniform(random) * 170.0 - 85.0;
+      toLon = uniform(random) * 360.0 - 180.0;
+    }
+
+    data.latitudeE7 = lround(fromLat * 1e7);
+    data.longitudeE7 = lround(fromLon * 1e7);
+    data.fastWaypointLatitudeE7 = lround(toLat * 1e7);
+    data.fastWaypointLongitudeE7 = lround(toLon * 1e7);
+    data.forwardDirection = random();
+    const types::Hands& hands = recalculate();
+
+    uint8_t dist;
+    uint8_t dir;
+    floatDistanceAndDirection(dist,
+                              dir,
+                              data.latitudeE7,
+                              data.longitudeE7,
+                              data.fastWaypointLatitudeE7,
+                              data.fastWaypointLongitudeE7,
+                              data.forwardDirection);
+    distanceError = max(distanceError, handError(hands.smallHand, dist));
+    directionError = max(directionError, handError(hands.mediumHand, dir));
+  }
+
+  bool ok = true;
+  ok &= check("time of day", timeError);
+  ok &= check("north", northError);
+  ok &= check("speed", speedError);
+  ok &= check("altitude", altitudeError);
+  ok &= check("distance", distanceError);
+  ok &= check("direction", directionError);
+
+  return ok ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Times Display::process() working out all three waypoint hands against the
+// double code it replaced, over the same random waypoints. process() also
+// redraws the pixels and plans the hands' moves, and the host has a floating
+// point unit where the watch doesn't, so both of these flatter the doubles.
+int displayBench()
+{
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  types::MotorConfig noMotor;
+  noMotor.pinA1 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinA2 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinB1 = POCKETWATCH__MOTOR__NOPIN;
+  noMotor.pinB2 = POCKETWATCH__MOTOR__NOPIN;
+  display.start(1500,
+                6000,
+                POCKETWATCH__DISPLAY__NUMPOSITIONS,
+                960,
+                noMotor,
+                noMotor,
+                noMotor,
+                false);
+
+  std::vector<types::SensorData> samples(POCKETWATCH__DISPLAYTEST__BENCHSAMPLES);
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    types::SensorData& sample = samples[i];
+    sample = types::SensorData();
+    sample.selection = 2;
+    sample.latitudeE7 = lround((uniform(random) * 170.0 - 85.0) * 1e7);
+    sample.longitudeE7 = lround((uniform(random) * 360.0 - 180.0) * 1e7);
+    sample.fastWaypointLatitudeE7 = lround((uniform(random) * 170.0 - 85.0) * 1e7);
+    sample.fastWaypointLongitudeE7 = lround((uniform(random) * 360.0 - 180.0) * 1e7);
+    sample.forwardDirection = random();
+  }
+
+  unsigned long fixedCost = 0;
+  unsigned long doubleCost = 0;
+  unsigned long sink = 0;
+  for (uint8_t round = 0; round < POCKETWATCH__DISPLAYTEST__BENCHROUNDS; ++round)
+  {
+    unsigned long start = cycles();
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+      // A new generation on everything, so every hand is worked out again
+      samples[i].gpsGeneration = round * 2 + 1;
+      samples[i].directionGeneration = round * 2 + 1;
+      samples[i].positionGeneration = i;
+      samples[i].waypointGeneration = round * 2 + 1;
+      display.process(samples[i]);
+      sink += display.getHands().smallHand;
+    }
+    fixedCost += cycles() - start;
+
+    start = cycles();
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+      const types::SensorData& sample = samples[i];
+      uint8_t dist;
+      uint8_t dir;
+      floatDistanceAndDirection(dist,
+                                dir,
+                                sample.latitudeE7,
+                                sample.longitudeE7,
+                                sample.fastWaypointLatitudeE7,
+                                sample.fastWaypointLongitudeE7,
+                                sample.forwardDirection);
+      uint8_t north = floatNormalize(-sample.forwardDirection * 2.0 * M_PI / 65536.0, 2.0 * M_PI);
+      sink += dist + dir + north;
+    }
+    doubleCost += cycles() - start;
+  }
+
+  unsigned long runs = (unsigned long)samples.size() * POCKETWATCH__DISPLAYTEST__BENCHROUNDS;
+  printf("fixed point  %8lu runs %12lu cycles %8lu per run\n", runs, fixedCost, fixedCost / runs);
+  printf("double       %8lu runs %12lu cycles %8lu per run\n", runs, doubleCost, doubleCost / runs);
+
+  // Only looked at so the work above can't be optimized away
+  return (sink == 0) ? 1 : 0;
+}
+
+} // end namespace host
+} // end namespace pocketwatch
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if ((argc > 1) && (std::string(argv[1]) == "--bench"))
+  {
+    return pocketwatch::host::displayBench();
+  }
+  return pocketwatch::host::displayTest();
+}
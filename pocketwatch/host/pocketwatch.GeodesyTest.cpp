@@ -0,0 +1,162 @@
+// Checks the fixed-point geodesy kernel against the double-precision formulas
+// over random inputs, to the accuracy promised in pocketwatch.Geodesy.H.
+
+#include <Arduino.h>
+
+#include <stdio.h>
+
+#include <random>
+
+#include "../main/pocketwatch.Geodesy.H"
+
+#define POCKETWATCH__GEODESYTEST__SAMPLES 200000
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+bool check(const char* what, double error, double limit)
+{
+  bool ok = (error <= limit);
+  printf("%-18s %10.4f (limit %.4f)%s\n", what, error, limit, ok ? "" : "  FAILED");
+  return ok;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+double angleToDegrees(double angle)
+{
+  return angle * 360.0 / 65536.0;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int geodesyTest()
+{
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  double sineError = 0.0;
+  double arctanError = 0.0;
+  double logError = 0.0;
+  for (long i = 0; i < POCKETWATCH__GEODESYTEST__SAMPLES; ++i)
+  {
+    uint16_t angle = random();
+    double radians = angle * 2.0 * M_PI / 65536.0;
+    sineError = max(sineError, fabs(geodesy::sine(angle) / 32767.0 - sin(radians)) * 32767.0);
+    sineError = max(sineError, fabs(geodesy::cosine(angle) / 32767.0 - cos(radians)) * 32767.0);
+
+    int32_t y = (int32_t)random() >> (random() % 31);
+    int32_t x = (int32_t)random() >> (random() % 31);
+    if ((x != 0) || (y != 0))
+    {
+      double expected = atan2((double)y, (double)x) * 65536.0 / (2.0 * M_PI);
+      arctanError = max(arctanError, fabs(remainder(geodesy::arctan2(y, x) - expected, 65536.0)));
+    }
+
+    uint32_t value = (random() >> (random() % 31)) | 1;
+    logError = max(logError, fabs(geodesy::log2Q8(value) / 256.0 - log2((double)value)) * 256.0);
+  }
+
+  double nearDistanceError = 0.0;     // Relative
+  double farDistanceError = 0.0;      // Relative, beyond 1000 km
+  double shortFarDistanceError = 0.0; // Meters, under 1000 km
+  double nearBearingError = 0.0;      // Degrees
+  double farBearingError = 0.0;       // Degrees
+  for (long i = 0; i < POCKETWATCH__GEODESYTEST__SAMPLES; ++i)
+  {
+    double fromLat = uniform(random) * 170.0 - 85.0;
+    double fromLon = uniform(random) * 360.0 - 180.0;
+    double toLat;
+    double toLon;
+    if (i % 2)
+    {
+      // Anywhere from 10 cm to 40 km away
+      double scale = pow(10.0, -6.0 + uniform(random) * 5.6);
+      toLat = max(-89.0, min(89.0, fromLat + (uniform(random) * 2.0 - 1.0) * scale));
+      toLon = remainder(fromLon + (uniform(random) * 2.0 - 1.0) * scale, 360.0);
+    }
+    else
+    {
+      toLat = uniform(random) * 170.0 - 85.0;
+      toLon = uniform(random) * 360.0 - 180.0;
+    }
+
+    int32_t fromLatE7 = lround(fromLat * 1e7);
+    int32_t fromLonE7 = lround(fromLon * 1e7);
+    int32_t toLatE7 = lround(toLat * 1e7);
+    int32_t toLonE7 = lround(toLon * 1e7);
+
+    // Haversine on the rounded coordinates, so only the kernel's error counts
+    double lat1 = fromLatE7 * M_PI / 1.8e9;
+    double lon1 = fromLonE7 * M_PI / 1.8e9;
+    double lat2 = toLatE7 * M_PI / 1.8e9;
+    double lon2 = toLonE7 * M_PI / 1.8e9;
+    double a = sin((lat2 - lat1) / 2) * sin((lat2 - lat1) / 2) +
+               cos(lat1) * cos(lat2) * sin((lon2 - lon1) / 2) * sin((lon2 - lon1) / 2);
+    double distance = EARTH__RADIUS * 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
+    double bearing = atan2(sin(lon2 - lon1) * cos(lat2),
+                           cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(lon2 - lon1)) * 180.0 / M_PI;
+
+    uint32_t distanceCm;
+    uint16_t bearingAngle;
+    geodesy::distanceAndBearing(fromLatE7, fromLonE7, toLatE7, toLonE7, distanceCm, bearingAngle);
+
+    double distanceError = fabs(distanceCm / 100.0 - distance) / distance;
+    double bearingError = fabs(remainder(angleToDegrees(bearingAngle) - bearing, 360.0));
+
+    bool near = (labs(toLatE7 - fromLatE7) < POCKETWATCH__GEODESY__FLATLIMIT) &&
+                (fabs(remainder((double)toLonE7 - fromLonE7, 3.6e9)) < POCKETWATCH__GEODESY__FLATLIMIT);
+    if (near)
+    {
+      // Below a few meters, centimeter rounding dominates
+      if (distance > 5.0)
+      {
+        nearDistanceError = max(nearDistanceError, distanceError);
+      }
+      if (distance > 10.0)
+      {
+        nearBearingError = max(nearBearingError, bearingError);
+      }
+    }
+    else
+    {
+      // The central angle only has 611 m resolution
+      if (distance < 1000000.0)
+      {
+        shortFarDistanceError = max(shortFarDistanceError, distanceError * distance);
+      }
+      else
+      {
+        farDistanceError = max(farDistanceError, distanceError);
+      }
+      farBearingError = max(farBearingError, bearingError);
+    }
+  }
+
+  bool ok = true;
+  ok &= check("sine/cosine", sineError, 4.0);
+  ok &= check("arctan2", arctanError, 2.0);
+  ok &= check("log2Q8", logError, 2.0);
+  ok &= check("near distance", nearDistanceError, 0.01);
+  ok &= check("far distance", farDistanceError, 0.0125);
+  ok &= check("far distance (m)", shortFarDistanceError, 5000.0);
+  ok &= check("near bearing", nearBearingError, 0.25);
+  ok &= check("far bearing", farBearingError, 0.5);
+
+  return ok ? 0 : 1;
+}
+
+} // end namespace host
+} // end namespace pocketwatch
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int main()
+{
+  return pocketwatch::host::geodesyTest();
+}
@@ -0,0 +1,453 @@
+// Runs the whole sketch on the host against a recorded trace of what the GPS,
+// compass, selector and button were doing, on a virtual clock.
+//
+// Trace files have one event per line, times in milliseconds from power on:
+//   <ms> gps <NMEA sentence>     '$' and the checksum are added if left off
+//   <ms> compass <x> <y> <z>     raw magnetometer counts from then on
+//   <ms> select <analog value>   what analogRead() returns for the selector
+//   <ms> button <0|1>            whether the waypoint button is held
+//   <ms> nack <0|1>              whether the compass stops answering on I2C
+//   <ms> end                     stop here (otherwise, at the last event)
+// Blank lines and anything after '#' are ignored.
+//
+// Every --every milliseconds the simulator prints where the hands are (in half
+// steps from noon) and what the pixels are showing, and at the end how often
+// each task ran and what the peripherals were asked to do, including any hand
+// steps that came faster than the motors can follow and how much of the time
+// the CPU would have been awake rather than asleep. That output is the
+// same on every run, which is what the golden tests compare. --bench adds how
+// long each task took on the host, which isn't.
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Real time on the host, for the cost of each task: the cycle counter where
+// there is one, otherwise nanoseconds
+inline unsigned long cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return (unsigned long)__rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long)now.tv_sec * 1000000000UL + now.tv_nsec;
+#endif
+}
+
+} // end namespace host
+} // end namespace pocketwatch
+
+#define POCKETWATCH__SCHEDULER__PROFILE 1
+#define POCKETWATCH__SCHEDULER__PROFILECLOCK pocketwatch::host::cycles
+#define POCKETWATCH__SCHEDULER__VIRTUALSLEEP 1
+
+#include "../main/main.ino"
+
+// Stop if the sketch keeps running without letting time move
+#define POCKETWATCH__SIMULATOR__MAXSPINS 10000
+
+namespace pocketwatch
+{
+namespace host
+{
+
+struct Event
+{
+  enum Type
+  {
+    Gps,
+    Compass,
+    Select,
+    Button,
+    Nack,
+    End
+  };
+
+  unsigned long time; // Microseconds
+  Type type;
+  std::string sentence;
+  int values[3];
+};
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+std::string completeSentence(const std::string& body)
+{
+  std::string sentence = body;
+  if (sentence.empty() || (sentence[0] != '$'))
+  {
+    sentence = "$" + sentence;
+  }
+  if (sentence.find('*') == std::string::npos)
+  {
+    uint8_t checksum = 0;
+    for (size_t i = 1; i < sentence.size(); ++i)
+    {
+      checksum ^= (uint8_t)sentence[i];
+    }
+    char hex[4];
+    snprintf(hex, sizeof(hex), "*%02X", checksum);
+    sentence += hex;
+  }
+  return sentence + "\r\n";
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+bool loadTrace(const char* path, std::vector<Event>& events)
+{
+  std::ifstream file(path);
+  if ( ! file)
+  {
+    fprintf(stderr, "Can't open %s\n", path);
+    return false;
+  }
+
+  std::string line;
+  unsigned int lineNumber = 0;
+  while (std::getline(file, line))
+  {
+    ++lineNumber;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos)
+    {
+      line.erase(comment);
+    }
+
+    std::istringstream fields(line);
+    unsigned long ms;
+    std::string type;
+    if ( ! (fields >> ms))
+    {
+      continue;
+    }
+    fields >> type;
+
+    Event event;
+    event.time = ms * 1000UL;
+    event.values[0] = event.values[1] = event.values[2] = 0;
+    bool ok = true;
+    if (type == "gps")
+    {
+      event.type = Event::Gps;
+      ok = (bool)(fields >> event.sentence);
+      event.sentence = completeSentence(event.sentence);
+    }
+    else if (type == "compass")
+    {
+      event.type = Event::Compass;
+      ok = (bool)(fields >> event.values[0] >> event.values[1] >> event.values[2]);
+    }
+    else if ((type == "select") || (type == "button") || (type == "nack"))
+    {
+      event.type = (type == "select") ? Event::Select : ((type == "button") ? Event::Button : Event::Nack);
+      ok = (bool)(fields >> event.values[0]);
+    }
+    else if (type == "end")
+    {
+      event.type = Event::End;
+    }
+    else
+    {
+      ok = false;
+    }
+
+    if ( ! ok)
+    {
+      fprintf(stderr, "%s:%u: can't read this line\n", path, lineNumber);
+      return false;
+    }
+    if ( ! events.empty() && (event.time < events.back().time))
+    {
+      fprintf(stderr, "%s:%u: events must be in order\n", path, lineNumber);
+      return false;
+    }
+    events.push_back(event);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+void applyEvent(const Event& event)
+{
+  switch (event.type)
+  {
+    case Event::Gps:
+      gpsLine.send(event.time, event.sentence);
+      break;
+    case Event::Compass:
+      magnetometer.x = event.values[0];
+      magnetometer.y = event.values[1];
+      magnetometer.z = event.values[2];
+      break;
+    case Event::Select:
+      pins.analog[POCKETWATCH__PINOUT__SELECTOR_INPUT] = event.values[0];
+      break;
+    case Event::Button:
+      pins.inputs[POCKETWATCH__PINOUT__BUTTON] = event.values[0] ? HIGH : LOW;
+      break;
+    case Event::Nack:
+      magnetometer.nack = (event.values[0] != 0);
+      break;
+    default:
+      break;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+const char* taskName(uint8_t taskId)
+{
+  Scheduler::Callback callback = scheduler.getCallback(taskId);
+  if (taskId == compassReadTask) return "compass read";
+  if (callback == blinkerProcess) return "blinker";
+  if (callback == compassProcess) return "compass";
+  if (callback == gpsProcess) return "gps";
+  if (callback == selectorProcess) return "selector";
+  if (callback == waypointKeeperProcess) return "waypoints";
+  if (callback == fusionProcess) return "fusion";
+  if (callback == displayProcess) return "display";
+  if (callback == handProcess) return "hands";
+  if (callback == pixelProcess) return "pixels";
+  if (callback == dutyCycleReport) return "duty cycle";
+  return "?";
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+void printHand(const Stepper* stepper)
+{
+  if (stepper == NULL)
+  {
+    printf(" -");
+    return;
+  }
+  long position = stepper->position % POCKETWATCH__HANDS__STEPS_PER_REVOLUTION;
+  if (position < 0)
+  {
+    position += POCKETWATCH__HANDS__STEPS_PER_REVOLUTION;
+  }
+  printf(" %ld", position);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+void printSnapshot(const Stepper* big, const Stepper* medium, const Stepper* small)
+{
+  printf("%lu hands", millis());
+  printHand(big);
+  printHand(medium);
+  printHand(small);
+  printf(" pixels");
+  const std::vector<uint32_t>& shown = strip.getShown();
+  for (size_t i = 0; i < shown.size(); ++i)
+  {
+    printf(" %06x", shown[i]);
+  }
+  printf("\n");
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+void printSummary(const Stepper* steppers, uint8_t numSteppers, bool bench)
+{
+  printf("tasks\n");
+  for (uint8_t i = 0; i < scheduler.getNumTasks(); ++i)
+  {
+    unsigned long runs = scheduler.getNumRuns(i);
+    printf("  %-12s %8lu runs", taskName(i), runs);
+    if (bench)
+    {
+      unsigned long cost = scheduler.getCost(i);
+      printf(" %12lu cycles %8lu per run", cost, runs ? cost / runs : 0);
+    }
+    printf("\n");
+  }
+
+  unsigned long steps = 0;
+  unsigned long badSteps = 0;
+  unsigned long fastSteps = 0;
+  for (uint8_t i = 0; i < numSteppers; ++i)
+  {
+    steps += steppers[i].numSteps;
+    badSteps += steppers[i].numBadSteps;
+    fastSteps += steppers[i].numFastSteps;
+  }
+
+  printf("duty cycle   %8u per mille awake\n", scheduler.getDutyCyclePermille(clock.now));
+  printf("hands        %8lu steps %lu skipped %lu too fast\n", steps, badSteps, fastSteps);
+  printf("pins         %8lu writes\n", pins.numWrites);
+  printf("pixels       %8lu shows %lu changed %lu usec\n",
+         strip.getNumShows(), strip.getNumChangedShows(), strip.getShowMicros());
+  printf("serial       %8lu bytes\n", Serial.numBytes);
+  printf("gps          %8lu received %lu dropped\n", gpsLine.numReceived, gpsLine.numDropped);
+  printf("i2c          %8lu transmissions %lu requests %lu resets\n",
+         Wire.numTransmissions, Wire.numRequests, Wire.numResets);
+  printf("eeprom       %8lu reads %lu writes %lu most to one cell\n",
+         EEPROM.numReads, EEPROM.numWrites, EEPROM.maxWear());
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int simulate(const char* tracePath, unsigned long every, bool bench)
+{
+  std::vector<Event> events;
+  if ( ! loadTrace(tracePath, events))
+  {
+    return 1;
+  }
+
+  unsigned long endTime = events.empty() ? 0 : events.back().time;
+
+  // Watch the motor pins, so the hands are where the motors really put them
+  // rather than where the sketch thinks they are
+  const Stepper* big = NULL;
+  const Stepper* medium = NULL;
+  const Stepper* small = NULL;
+  if (POCKETWATCH__PINOUT__BIG_MOTOR_A1 != POCKETWATCH__MOTOR__NOPIN)
+  {
+    big = &pins.addStepper(POCKETWATCH__PINOUT__BIG_MOTOR_A1,
+                           POCKETWATCH__PINOUT__BIG_MOTOR_A2,
+                           POCKETWATCH__PINOUT__BIG_MOTOR_B1,
+                           POCKETWATCH__PINOUT__BIG_MOTOR_B2,
+                           POCKETWATCH__HANDS__MIN_STEP_USEC);
+  }
+  if (POCKETWATCH__PINOUT__MEDIUM_MOTOR_A1 != POCKETWATCH__MOTOR__NOPIN)
+  {
+    medium = &pins.addStepper(POCKETWATCH__PINOUT__MEDIUM_MOTOR_A1,
+                              POCKETWATCH__PINOUT__MEDIUM_MOTOR_A2,
+                              POCKETWATCH__PINOUT__MEDIUM_MOTOR_B1,
+                              POCKETWATCH__PINOUT__MEDIUM_MOTOR_B2,
+                              POCKETWATCH__HANDS__MIN_STEP_USEC);
+  }
+  if (POCKETWATCH__PINOUT__SMALL_MOTOR_A1 != POCKETWATCH__MOTOR__NOPIN)
+  {
+    small = &pins.addStepper(POCKETWATCH__PINOUT__SMALL_MOTOR_A1,
+                             POCKETWATCH__PINOUT__SMALL_MOTOR_A2,
+                             POCKETWATCH__PINOUT__SMALL_MOTOR_B1,
+                             POCKETWATCH__PINOUT__SMALL_MOTOR_B2,
+                             POCKETWATCH__HANDS__MIN_STEP_USEC);
+  }
+
+  // Whatever is true at power on is there for setup() to see
+  size_t nextEvent = 0;
+  for (; (nextEvent < events.size()) && (events[nextEvent].time == 0); ++nextEvent)
+  {
+    applyEvent(events[nextEvent]);
+  }
+
+  setup();
+
+  unsigned long nextSnapshot = every * 1000UL;
+  unsigned int spins = 0;
+  while (clock.now < endTime)
+  {
+    for (; (nextEvent < events.size()) && (events[nextEvent].time <= clock.now); ++nextEvent)
+    {
+      applyEvent(events[nextEvent]);
+    }
+
+    loop();
+
+    if ((every != 0) && (clock.now >= nextSnapshot))
+    {
+      printSnapshot(big, medium, small);
+      nextSnapshot += every * 1000UL;
+    }
+
+    // Sleep until something is due: a task, a trace event or a snapshot
+    unsigned long next = endTime;
+    if (scheduler.hasDeadline() && ((long)(scheduler.getNextDeadline() - next) < 0))
+    {
+      next = scheduler.getNextDeadline();
+    }
+    if ((nextEvent < events.size()) && (events[nextEvent].time < next))
+    {
+      next = events[nextEvent].time;
+    }
+    if ((every != 0) && (nextSnapshot < next))
+    {
+      next = nextSnapshot;
+    }
+
+    if ((long)(next - clock.now) > 0)
+    {
+      clock.advanceTo(next);
+      spins = 0;
+    }
+    else if (++spins > POCKETWATCH__SIMULATOR__MAXSPINS)
+    {
+      fprintf(stderr, "Time stopped at %lu usec\n", clock.now);
+      return 1;
+    }
+  }
+
+  printSummary(pins.steppers, pins.numSteppers, bench);
+  return 0;
+}
+
+} // end namespace host
+} // end namespace pocketwatch
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  const char* tracePath = NULL;
+  unsigned long every = 1000;
+  bool bench = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--bench")
+    {
+      bench = true;
+    }
+    else if (arg == "--serial")
+    {
+      Serial.echo = true;
+    }
+    else if ((arg == "--every") && (i + 1 < argc))
+    {
+      every = strtoul(argv[++i], NULL, 10);
+    }
+    else if (tracePath == NULL)
+    {
+      tracePath = argv[i];
+    }
+    else
+    {
+      tracePath = NULL;
+      break;
+    }
+  }
+
+  if (tracePath == NULL)
+  {
+    fprintf(stderr, "Usage: %s [--every <ms>] [--bench] [--serial] <trace>\n", argv[0]);
+    return 2;
+  }
+
+  return pocketwatch::host::simulate(tracePath, every, bench);
+}
@@ -0,0 +1,150 @@
+// Checks that WaypointKeeper's EEPROM rings come back the way they were left:
+// through reloads, torn writes, sequence numbers wrapping round, and writes
+// spread over every record of a ring.
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../main/pocketwatch.WaypointKeeper.H"
+
+// Where things are in each 16 byte record
+#define POCKETWATCH__WAYPOINTKEEPERTEST__RECORDSIZE 16
+#define POCKETWATCH__WAYPOINTKEEPERTEST__SEQUENCEOFFSET 8
+#define POCKETWATCH__WAYPOINTKEEPERTEST__CRCOFFSET 15
+
+namespace pocketwatch
+{
+namespace host
+{
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+bool check(const char* what, bool ok)
+{
+  printf("%-28s %s\n", what, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+uint16_t recordAddress(uint8_t index, uint8_t slot)
+{
+  return POCKETWATCH__WAYPOINTKEEPER__EEPROMSTART +
+         (index * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT + slot) *
+         POCKETWATCH__WAYPOINTKEEPERTEST__RECORDSIZE;
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+// Starts a keeper the way setup() does, so everything comes from EEPROM
+void reload(WaypointKeeper& keeper)
+{
+  keeper = WaypointKeeper();
+  keeper.start(A1, 0, 200, 3000, 2000, 10000, 2, 4);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+bool holds(const WaypointKeeper& keeper, uint8_t index, int32_t latE7, int32_t lonE7, const char* name)
+{
+  return keeper.isValid(index) &&
+         (keeper.getLatitudeE7(index) == latE7) &&
+         (keeper.getLongitudeE7(index) == lonE7) &&
+         (strcmp(keeper.getName(index), name) == 0);
+}
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int waypointKeeperTest()
+{
+  WaypointKeeper keeper;
+  bool ok = true;
+
+  // Erased EEPROM, and nothing to carry over from the old format
+  reload(keeper);
+  bool empty = true;
+  for (uint8_t i = 0; i < POCKETWATCH__WAYPOINTKEEPER__NUMWAYPOINTS; ++i)
+  {
+    empty &= ! keeper.isValid(i);
+  }
+  ok &= check("erased", empty);
+
+  // Both waypoints, and names that overflow and underfill the record
+  keeper.setWaypoint(POCKETWATCH__WAYPOINTKEEPER__FAST, 397318280, -1049604090, "Trailhead");
+  keeper.setWaypoint(POCKETWATCH__WAYPOINTKEEPER__SLOW, -433041530, 1232611470, "Hm");
+  bool setOk = ! keeper.setWaypoint(POCKETWATCH__WAYPOINTKEEPER__NUMWAYPOINTS, 0, 0, "None");
+  reload(keeper);
+  setOk &= holds(keeper, POCKETWATCH__WAYPOINTKEEPER__FAST, 397318280, -1049604090, "Trail");
+  setOk &= holds(keeper, POCKETWATCH__WAYPOINTKEEPER__SLOW, -433041530, 1232611470, "Hm");
+  ok &= check("both waypoints and names", setOk);
+
+  // Saving one waypoint over and over goes round its ring, every record taking
+  // the same share, and leaves the other waypoint's cells alone
+  const uint8_t ring = POCKETWATCH__WAYPOINTKEEPER__SLOW;
+  EEPROM.erase();
+  reload(keeper);
+  unsigned long writesBefore = EEPROM.numWrites;
+  const uint8_t rounds = 10;
+  for (uint8_t n = 0; n < rounds * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT; ++n)
+  {
+    keeper.setWaypoint(ring, 400000000L + n, -1050000000L, "Ring");
+  }
+  bool ringOk = true;
+  for (uint8_t slot = 0; slot < POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT; ++slot)
+  {
+    uint16_t address = recordAddress(ring, slot) + POCKETWATCH__WAYPOINTKEEPERTEST__SEQUENCEOFFSET;
+    ringOk &= (EEPROM.wear[address] == rounds);
+  }
+  unsigned long ringWear = 0;
+  for (uint16_t a = recordAddress(ring, 0); a < recordAddress(ring + 1, 0); ++a)
+  {
+    ringWear += EEPROM.wear[a];
+  }
+  ringOk &= (ringWear == EEPROM.numWrites - writesBefore);
+  ringOk &= (EEPROM.maxWear() <= rounds);
+  reload(keeper);
+  ringOk &= holds(keeper, ring, 400000000L + rounds * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT - 1, -1050000000L, "Ring");
+  ok &= check("writes go round the ring", ringOk);
+
+  // A write cut off before its CRC went in (to slot 0, after the 70 above)
+  // leaves the previous record in charge, and the next write takes its place
+  keeper.setWaypoint(ring, 410000000L, -1050000000L, "Torn");
+  EEPROM.cells[recordAddress(ring, 0) + POCKETWATCH__WAYPOINTKEEPERTEST__CRCOFFSET] ^= 0x01;
+  reload(keeper);
+  bool tornOk = holds(keeper, ring, 400000000L + rounds * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT - 1, -1050000000L, "Ring");
+  keeper.setWaypoint(ring, 420000000L, -1050000000L, "Next");
+  reload(keeper);
+  tornOk &= holds(keeper, ring, 420000000L, -1050000000L, "Next");
+  ok &= check("torn write", tornOk);
+
+  // Sequence numbers wrap round after 65535 writes, and the newest record
+  // has to keep winning on the way through
+  EEPROM.erase();
+  reload(keeper);
+  bool wrapOk = true;
+  for (long n = 0; n < 65536L + 2 * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT; ++n)
+  {
+    keeper.setWaypoint(POCKETWATCH__WAYPOINTKEEPER__FAST, (int32_t)n, 0, "Wrap");
+    if (n >= 65536L - 2 * POCKETWATCH__WAYPOINTKEEPER__RECORDSPERWAYPOINT)
+    {
+      reload(keeper);
+      wrapOk &= holds(keeper, POCKETWATCH__WAYPOINTKEEPER__FAST, (int32_t)n, 0, "Wrap");
+    }
+  }
+  ok &= check("sequence wrap", wrapOk);
+
+  return ok ? 0 : 1;
+}
+
+} // end namespace host
+} // end namespace pocketwatch
+
+// -----------------------------------------------------------------------------
+// -----------------------------------------------------------------------------
+int main()
+{
+  return pocketwatch::host::waypointKeeperTest();
+}
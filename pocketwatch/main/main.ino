@@ -1,10 +1,20 @@
+// Uncomment to print what the watch is doing over the USB serial port
+//#define DEBUG 1
 
+// Uncomment to have the pixels follow the hands as they move, redrawn this
+// often, instead of jumping straight to where the hands are going
+//#define PIXEL_FRAME_PERIOD (40 * MSEC)
 
+// Uncomment to have the GPS send five fixes a second instead of one
+//#define GPS_FAST_UPDATES 1
 
 #include "pocketwatch.Blinker.H"
 #include "pocketwatch.Compass.H"
 #include "pocketwatch.Display.H"
+#include "pocketwatch.Fusion.H"
 #include "pocketwatch.GPS.H"
+#include "pocketwatch.Geodesy.H"
+#include "pocketwatch.Scheduler.H"
 #include "pocketwatch.Selector.H"
 #include "pocketwatch.Types.H"
 #include "pocketwatch.WaypointKeeper.H"
@@ -14,33 +24,95 @@
 #define POCKETWATCH__PINOUT__GPS__RX 2
 #define POCKETWATCH__PINOUT__SELECTOR_INPUT A0
 #define POCKETWATCH__PINOUT__BUTTON A1
+#define POCKETWATCH__PINOUT__COMPASS_DRDY POCKETWATCH__COMPASS__NOPIN
+#define POCKETWATCH__PINOUT__BIG_MOTOR_A1 8
+#define POCKETWATCH__PINOUT__BIG_MOTOR_A2 11
+#define POCKETWATCH__PINOUT__BIG_MOTOR_B1 9
+#define POCKETWATCH__PINOUT__BIG_MOTOR_B2 12
+#define POCKETWATCH__PINOUT__MEDIUM_MOTOR_A1 4
+#define POCKETWATCH__PINOUT__MEDIUM_MOTOR_A2 7
+#define POCKETWATCH__PINOUT__MEDIUM_MOTOR_B1 5
+#define POCKETWATCH__PINOUT__MEDIUM_MOTOR_B2 10
+// There aren't enough free pins left for the small hand's driver on this board
+#define POCKETWATCH__PINOUT__SMALL_MOTOR_A1 POCKETWATCH__MOTOR__NOPIN
+#define POCKETWATCH__PINOUT__SMALL_MOTOR_A2 POCKETWATCH__MOTOR__NOPIN
+#define POCKETWATCH__PINOUT__SMALL_MOTOR_B1 POCKETWATCH__MOTOR__NOPIN
+#define POCKETWATCH__PINOUT__SMALL_MOTOR_B2 POCKETWATCH__MOTOR__NOPIN
+// Half steps for one full turn of a hand
+#define POCKETWATCH__HANDS__STEPS_PER_REVOLUTION 960
+// Hands start at one step per 6 ms and speed up to one step per 1.5 ms
+#define POCKETWATCH__HANDS__START_STEP_USEC 6000
+#define POCKETWATCH__HANDS__MIN_STEP_USEC 1500
 #define MSEC 1
 #define SEC (1000 * MSEC)
+// The scheduler counts in microseconds
+#define USEC_PER_MSEC 1000UL
 
-//#define DEBUG 1
+#if defined(PIXEL_FRAME_PERIOD)
+#define PIXELS_FOLLOW_HANDS true
+#else
+#define PIXELS_FOLLOW_HANDS false
+#endif
 
+#if defined(GPS_FAST_UPDATES)
+#define GPS_UPDATES_ARE_FAST true
+#define GPS_PERIOD (10 * MSEC)
+#else
+#define GPS_UPDATES_ARE_FAST false
+#define GPS_PERIOD (20 * MSEC)
+#endif
 
 pocketwatch::Blinker blinker;
 pocketwatch::Compass compass;
 pocketwatch::Display displayer;
+pocketwatch::Fusion fusion;
 pocketwatch::GPS gps(POCKETWATCH__PINOUT__GPS__TX, POCKETWATCH__PINOUT__GPS__RX);
 pocketwatch::Selector selector;
 pocketwatch::WaypointKeeper waypointKeeper;
+pocketwatch::Scheduler scheduler;
+
+// What the display works from. Each component publishes its part when it changes.
+pocketwatch::types::SensorData sensorData;
+
+uint8_t blinkerTask;
+uint8_t compassReadTask;
+uint8_t handTask;
+
+
+void blinkerProcess(pocketwatch::time_t currentMicros);
+void compassProcess(pocketwatch::time_t currentMicros);
+void gpsProcess(pocketwatch::time_t currentMicros);
+void selectorProcess(pocketwatch::time_t currentMicros);
+void waypointKeeperProcess(pocketwatch::time_t currentMicros);
+void fusionProcess(pocketwatch::time_t currentMicros);
+void displayProcess(pocketwatch::time_t currentMicros);
+void handProcess(pocketwatch::time_t currentMicros);
+void pixelProcess(pocketwatch::time_t currentMicros);
+void dutyCycleReport(pocketwatch::time_t currentMicros);
+void scheduleHands();
+void publishSelector();
+void publishGPS();
+void publishWaypoints();
+void publishFusion();
 
 
 void setup() {
   unsigned long currentTime = millis();
+  unsigned long currentMicros = micros();
+
+#ifdef DEBUG
+  Serial.begin(9600);
+#endif
   
   blinker.start(POCKETWATCH__PINOUT__LED,
-                currentTime,
                 2 * SEC,
                 2 * SEC);
-  compass.start(currentTime,
-                200 * MSEC);
-  gps.start(currentTime);
+  compass.start(20 * MSEC,
+                8,
+                POCKETWATCH__PINOUT__COMPASS_DRDY);
+  gps.start(currentTime, GPS_UPDATES_ARE_FAST);
   selector.start(POCKETWATCH__PINOUT__SELECTOR_INPUT,
                  currentTime,
-                 50 * MSEC,
                  250 * MSEC,
                  4,
                  330.0/340.0);
@@ -54,12 +126,65 @@ void setup() {
                        4);
 
   pocketwatch::types::MotorConfig bigConfig;
-  bigConfig.pinA1 = 8;
-  bigConfig.pinA2 = 11;
-  bigConfig.pinB1 = 9;
-  bigConfig.pinB2 = 12;
+  bigConfig.pinA1 = POCKETWATCH__PINOUT__BIG_MOTOR_A1;
+  bigConfig.pinA2 = POCKETWATCH__PINOUT__BIG_MOTOR_A2;
+  bigConfig.pinB1 = POCKETWATCH__PINOUT__BIG_MOTOR_B1;
+  bigConfig.pinB2 = POCKETWATCH__PINOUT__BIG_MOTOR_B2;
+
+  pocketwatch::types::MotorConfig mediumConfig;
+  mediumConfig.pinA1 = POCKETWATCH__PINOUT__MEDIUM_MOTOR_A1;
+  mediumConfig.pinA2 = POCKETWATCH__PINOUT__MEDIUM_MOTOR_A2;
+  mediumConfig.pinB1 = POCKETWATCH__PINOUT__MEDIUM_MOTOR_B1;
+  mediumConfig.pinB2 = POCKETWATCH__PINOUT__MEDIUM_MOTOR_B2;
+
+  pocketwatch::types::MotorConfig smallConfig;
+  smallConfig.pinA1 = POCKETWATCH__PINOUT__SMALL_MOTOR_A1;
+  smallConfig.pinA2 = POCKETWATCH__PINOUT__SMALL_MOTOR_A2;
+  smallConfig.pinB1 = POCKETWATCH__PINOUT__SMALL_MOTOR_B1;
+  smallConfig.pinB2 = POCKETWATCH__PINOUT__SMALL_MOTOR_B2;
+
+  displayer.start(POCKETWATCH__HANDS__MIN_STEP_USEC,
+                  POCKETWATCH__HANDS__START_STEP_USEC,
+                  120,
+                  POCKETWATCH__HANDS__STEPS_PER_REVOLUTION,
+                  bigConfig,
+                  mediumConfig,
+                  smallConfig,
+                  PIXELS_FOLLOW_HANDS);
+
+  // Holding the button down while powering on calibrates the compass: spin the
+  // watch through every orientation until the calibration time is up.
+  if (digitalRead(POCKETWATCH__PINOUT__BUTTON) == HIGH)
+  {
+    compass.calibrate(currentTime, 20 * SEC);
+  }
+
+  publishSelector();
+  publishGPS();
+  publishWaypoints();
+  publishFusion();
 
-  displayer.start(currentTime, 500 * MSEC, 3 * MSEC, 120, bigConfig);
+  // Each component runs only as often as it needs to, and does its work
+  // whenever it's run. The GPS's period is set by the 64 character
+  // SoftwareSerial buffer, which fills in about 66 ms (17 ms at the faster rate
+  // fast updates use).
+  scheduler.start(currentMicros);
+  blinkerTask = scheduler.addOneShot(blinkerProcess);
+  scheduler.schedule(blinkerTask, currentMicros + blinker.getStateDuration() * USEC_PER_MSEC);
+  scheduler.addPeriodic(compassProcess, currentMicros + 200 * MSEC * USEC_PER_MSEC, 200 * MSEC * USEC_PER_MSEC);
+  scheduler.addPeriodic(gpsProcess, currentMicros + GPS_PERIOD * USEC_PER_MSEC, GPS_PERIOD * USEC_PER_MSEC);
+  scheduler.addPeriodic(selectorProcess, currentMicros + 50 * MSEC * USEC_PER_MSEC, 50 * MSEC * USEC_PER_MSEC);
+  scheduler.addPeriodic(waypointKeeperProcess, currentMicros + 50 * MSEC * USEC_PER_MSEC, 50 * MSEC * USEC_PER_MSEC);
+  scheduler.addPeriodic(fusionProcess, currentMicros + 100 * MSEC * USEC_PER_MSEC, 100 * MSEC * USEC_PER_MSEC);
+  scheduler.addPeriodic(displayProcess, currentMicros + 500 * MSEC * USEC_PER_MSEC, 500 * MSEC * USEC_PER_MSEC);
+  compassReadTask = scheduler.addOneShot(compassProcess);
+  handTask = scheduler.addOneShot(handProcess);
+#if defined(PIXEL_FRAME_PERIOD)
+  scheduler.addPeriodic(pixelProcess, currentMicros + PIXEL_FRAME_PERIOD * USEC_PER_MSEC, PIXEL_FRAME_PERIOD * USEC_PER_MSEC);
+#endif
+#ifdef DEBUG
+  scheduler.addPeriodic(dutyCycleReport, currentMicros + 10 * SEC * USEC_PER_MSEC, 10 * SEC * USEC_PER_MSEC);
+#endif
 
   delay(100);
 
@@ -67,39 +192,121 @@ void setup() {
 }
 
 void loop() {
-  unsigned long currentTime = millis();
-  
-  blinker.process(currentTime);
-  compass.process(currentTime);
-  gps.process(currentTime);
-  selector.process(currentTime);
+  scheduler.run(micros());
+  scheduler.sleepUntilNextDeadline();
+}
+
+void blinkerProcess(pocketwatch::time_t currentMicros) {
+  blinker.process();
+  scheduler.schedule(blinkerTask, currentMicros + blinker.getStateDuration() * USEC_PER_MSEC);
+}
+
+void compassProcess(pocketwatch::time_t currentMicros) {
+  // Nothing reads the compass through sensorData; fusion takes the heading
+  // straight from it
+  compass.process(millis());
+
+  // The bytes asked for are collected on the next call, so come back soon
+  if (compass.isReading())
+  {
+    scheduler.schedule(compassReadTask, currentMicros + 1 * MSEC * USEC_PER_MSEC);
+  }
+}
+
+void gpsProcess(pocketwatch::time_t currentMicros) {
+  gps.process(millis());
+  if (gps.getGeneration() != sensorData.gpsGeneration)
+  {
+    publishGPS();
+  }
+}
+
+void selectorProcess(pocketwatch::time_t currentMicros) {
+  selector.process(millis());
+  if (selector.getGeneration() != sensorData.selectorGeneration)
+  {
+    publishSelector();
+  }
+}
+
+void waypointKeeperProcess(pocketwatch::time_t currentMicros) {
   const pocketwatch::GPSData& gpsData = gps.getGPSData();
-  waypointKeeper.process(currentTime,
-                         gpsData.latitude,
-                         gpsData.longitude);
-
-  pocketwatch::types::SensorData data;
-  data.selection = selector.getChoice();
-  data.heading = compass.getHeading();
-  data.compassX = compass.getX();
-  data.compassY = compass.getY();
-  data.compassZ = compass.getZ();
-  data.yearSince2000 = gpsData.yearSince2000;
-  data.month = gpsData.month;
-  data.day = gpsData.day;
-  data.hour = gpsData.hour;
-  data.minute = gpsData.minute;
-  data.second = gpsData.second;
-  data.latitude = gpsData.latitude;
-  data.longitude = gpsData.longitude;
-  data.groundSpeedKnots = gpsData.groundSpeedKnots;
-  data.trackAngle = gpsData.trackAngle;
-  data.altitudeMeters = gpsData.altitudeMeters;
-  data.fastWaypointLatitude = waypointKeeper.getFastLat();
-  data.fastWaypointLongitude = waypointKeeper.getFastLon();
-  data.slowWaypointLatitude = waypointKeeper.getSlowLat();
-  data.slowWaypointLongitude = waypointKeeper.getSlowLon();
-
-
-  displayer.process(currentTime, data);
+  waypointKeeper.process(millis(),
+                         gpsData.latitudeE7,
+                         gpsData.longitudeE7);
+  if (waypointKeeper.getGeneration() != sensorData.waypointGeneration)
+  {
+    publishWaypoints();
+  }
+}
+
+void fusionProcess(pocketwatch::time_t currentMicros) {
+  fusion.process(millis(),
+                 compass.getHeading(),
+                 gps.getGPSData());
+  if ((fusion.getDirectionGeneration() != sensorData.directionGeneration) ||
+      (fusion.getPositionGeneration() != sensorData.positionGeneration))
+  {
+    publishFusion();
+  }
+}
+
+void displayProcess(pocketwatch::time_t currentMicros) {
+  displayer.process(sensorData);
+
+  // New targets may have set the hands moving
+  scheduleHands();
+}
+
+void handProcess(pocketwatch::time_t currentMicros) {
+  displayer.moveHands(currentMicros);
+  scheduleHands();
+}
+
+void pixelProcess(pocketwatch::time_t currentMicros) {
+  displayer.renderFrame();
+}
+
+void scheduleHands() {
+  if (displayer.handsAreMoving())
+  {
+    scheduler.schedule(handTask, displayer.getNextStepTime());
+  }
+}
+
+void publishSelector() {
+  sensorData.selection = selector.getChoice();
+  sensorData.selectorGeneration = selector.getGeneration();
+}
+
+void publishGPS() {
+  const pocketwatch::GPSData& gpsData = gps.getGPSData();
+  sensorData.hour = gpsData.hour;
+  sensorData.minute = gpsData.minute;
+  sensorData.second = gpsData.second;
+  sensorData.groundSpeedCentiKnots = gpsData.groundSpeedCentiKnots;
+  sensorData.altitudeDecimeters = gpsData.altitudeDecimeters;
+  sensorData.gpsGeneration = gps.getGeneration();
+}
+
+void publishWaypoints() {
+  sensorData.fastWaypointLatitudeE7 = waypointKeeper.getLatitudeE7(POCKETWATCH__WAYPOINTKEEPER__FAST);
+  sensorData.fastWaypointLongitudeE7 = waypointKeeper.getLongitudeE7(POCKETWATCH__WAYPOINTKEEPER__FAST);
+  sensorData.slowWaypointLatitudeE7 = waypointKeeper.getLatitudeE7(POCKETWATCH__WAYPOINTKEEPER__SLOW);
+  sensorData.slowWaypointLongitudeE7 = waypointKeeper.getLongitudeE7(POCKETWATCH__WAYPOINTKEEPER__SLOW);
+  sensorData.waypointGeneration = waypointKeeper.getGeneration();
+}
+
+void publishFusion() {
+  sensorData.forwardDirection = fusion.getForwardDirection();
+  sensorData.latitudeE7 = fusion.getLatitudeE7();
+  sensorData.longitudeE7 = fusion.getLongitudeE7();
+  sensorData.directionGeneration = fusion.getDirectionGeneration();
+  sensorData.positionGeneration = fusion.getPositionGeneration();
+}
+
+void dutyCycleReport(pocketwatch::time_t currentMicros) {
+  Serial.print("Duty cycle (per mille): ");
+  Serial.println(scheduler.getDutyCyclePermille(currentMicros));
+  scheduler.resetDutyCycle(currentMicros);
 }